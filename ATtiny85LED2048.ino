@@ -8,10 +8,14 @@ void setup(void)
 
 void loop(void)
 {
-    int8_t vx, vy;
-    getDPad(vx, vy);
-    updateGame(vx, vy);
+    static bool isFrame = true;
+    if (isFrame) {
+        int8_t vx, vy;
+        getDPad(vx, vy);
+        updateGame(vx, vy);
+        manageConfigByButton();
+    }
+    bool isAnimating = animateGame();
     refreshPixels();
-    manageConfigByButton();
-    delay(MILLIS_PER_FRAME);
+    isFrame = waitNextFrame(isAnimating);
 }
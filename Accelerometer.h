@@ -0,0 +1,181 @@
+#pragma once
+
+#include <Arduino.h>
+
+/*
+ *  Accelerometer drivers, selected at compile time by typedef.
+ *
+ *  Each driver reports the raw axes of the part scaled to 256 LSB/g, and
+ *  applies the offsets in units of (1 << OFFSET_SHIFT) LSBs, either by the
+ *  native offset registers or by adding them in software.
+ *
+ *    typedef ADXL345<SimpleWire1M> Accelerometer;
+ *    typedef LIS3DH<SimpleWire1M> Accelerometer;
+ */
+
+/*---------------------------------------------------------------------------*/
+
+#define ADXL345_I2C_ADDR            0x53
+#define ADXL345_REG_OFSX            0x1E
+#define ADXL345_REG_THRESH_ACT      0x24
+#define ADXL345_REG_ACT_INACT_CTL   0x27
+#define ADXL345_REG_BW_RATE         0x2C
+#define ADXL345_REG_POWER_CTL       0x2D
+#define ADXL345_REG_INT_ENABLE      0x2E
+#define ADXL345_REG_INT_SOURCE      0x30
+#define ADXL345_REG_DATA_FORMAT     0x31
+#define ADXL345_REG_DATAX0          0x32
+#define ADXL345_VAL_THRESH_ACT      4 // 250 mg
+#define ADXL345_VAL_ACT_AC_XYZ      0xF0
+#define ADXL345_VAL_LOW_POWER_12HZ  0x17
+#define ADXL345_VAL_LOW_POWER_25HZ  0x18
+#define ADXL345_VAL_INT_ACTIVITY    0x10
+#define ADXL345_VAL_FULL_RES_2G     0x08
+#define ADXL345_VAL_MEASURE         0x08
+
+template<class WIRE>
+class ADXL345
+{
+public:
+    static const uint8_t OFFSET_SHIFT = 2; // 15.6 mg
+
+    static void begin(const int8_t *pOffsets)
+    {
+        writeOffsets(pOffsets);
+        uint8_t data[2] = { ADXL345_VAL_LOW_POWER_25HZ, ADXL345_VAL_MEASURE };
+        WIRE::writeWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_BW_RATE, data, 2);
+        writeRegister(ADXL345_REG_DATA_FORMAT, ADXL345_VAL_FULL_RES_2G);
+    }
+
+    static bool read(int16_t &x, int16_t &y, int16_t &z)
+    {
+        uint8_t dac[6];
+        if (WIRE::readWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_DATAX0, dac, sizeof(dac)) <= 0) {
+            return false;
+        }
+        x = (dac[1] << 8) | dac[0];
+        y = (dac[3] << 8) | dac[2];
+        z = (dac[5] << 8) | dac[4];
+        return true;
+    }
+
+    static void writeOffsets(const int8_t *pOffsets)
+    {
+        WIRE::writeWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_OFSX, (const uint8_t *)pOffsets, 3);
+    }
+
+    static void armActivity(void)
+    {
+        writeRegister(ADXL345_REG_THRESH_ACT, ADXL345_VAL_THRESH_ACT);
+        writeRegister(ADXL345_REG_ACT_INACT_CTL, ADXL345_VAL_ACT_AC_XYZ);
+        writeRegister(ADXL345_REG_BW_RATE, ADXL345_VAL_LOW_POWER_12HZ);
+        writeRegister(ADXL345_REG_INT_ENABLE, ADXL345_VAL_INT_ACTIVITY);
+    }
+
+    static bool isActive(void)
+    {
+        uint8_t source = 0;
+        WIRE::readWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_INT_SOURCE, &source, 1);
+        return source & ADXL345_VAL_INT_ACTIVITY;
+    }
+
+    static void disarmActivity(void)
+    {
+        writeRegister(ADXL345_REG_INT_ENABLE, 0);
+        writeRegister(ADXL345_REG_BW_RATE, ADXL345_VAL_LOW_POWER_25HZ);
+    }
+
+private:
+    static void writeRegister(uint8_t reg, uint8_t value)
+    {
+        WIRE::writeWithCommand(ADXL345_I2C_ADDR, reg, &value, 1);
+    }
+};
+
+/*---------------------------------------------------------------------------*/
+
+#define LIS3DH_I2C_ADDR             0x18
+#define LIS3DH_REG_CTRL_REG1        0x20
+#define LIS3DH_REG_CTRL_REG2        0x21
+#define LIS3DH_REG_CTRL_REG4        0x23
+#define LIS3DH_REG_CTRL_REG5        0x24
+#define LIS3DH_REG_OUT_X_L          0x28
+#define LIS3DH_REG_INT1_CFG         0x30
+#define LIS3DH_REG_INT1_SRC         0x31
+#define LIS3DH_REG_INT1_THS         0x32
+#define LIS3DH_REG_AUTO_INCREMENT   0x80
+#define LIS3DH_VAL_NORMAL_25HZ      0x37
+#define LIS3DH_VAL_LOW_POWER_10HZ   0x2F
+#define LIS3DH_VAL_HP_INT1          0x01
+#define LIS3DH_VAL_BDU_HR_2G        0x88
+#define LIS3DH_VAL_LATCH_INT1       0x08
+#define LIS3DH_VAL_INT1_HIGH_XYZ    0x2A
+#define LIS3DH_VAL_INT1_ACTIVE      0x40
+#define LIS3DH_VAL_INT1_THS         16 // 250 mg
+
+template<class WIRE>
+class LIS3DH
+{
+public:
+    static const uint8_t OFFSET_SHIFT = 2;
+
+    static void begin(const int8_t *pOffsets)
+    {
+        writeOffsets(pOffsets);
+        writeRegister(LIS3DH_REG_CTRL_REG1, LIS3DH_VAL_NORMAL_25HZ);
+        writeRegister(LIS3DH_REG_CTRL_REG4, LIS3DH_VAL_BDU_HR_2G);
+    }
+
+    static bool read(int16_t &x, int16_t &y, int16_t &z)
+    {
+        uint8_t dac[6];
+        if (WIRE::readWithCommand(LIS3DH_I2C_ADDR,
+                LIS3DH_REG_OUT_X_L | LIS3DH_REG_AUTO_INCREMENT, dac, sizeof(dac)) <= 0) {
+            return false;
+        }
+        x = (((int16_t)((dac[1] << 8) | dac[0])) >> 6) + offsets[0] * (1 << OFFSET_SHIFT); // 16384 -> 256 LSB/g
+        y = (((int16_t)((dac[3] << 8) | dac[2])) >> 6) + offsets[1] * (1 << OFFSET_SHIFT);
+        z = (((int16_t)((dac[5] << 8) | dac[4])) >> 6) + offsets[2] * (1 << OFFSET_SHIFT);
+        return true;
+    }
+
+    static void writeOffsets(const int8_t *pOffsets)
+    {
+        /*  Added to the output in software, as the offset registers of ADXL345 do  */
+        memcpy(offsets, pOffsets, sizeof(offsets));
+    }
+
+    static void armActivity(void)
+    {
+        writeRegister(LIS3DH_REG_CTRL_REG2, LIS3DH_VAL_HP_INT1);
+        writeRegister(LIS3DH_REG_CTRL_REG5, LIS3DH_VAL_LATCH_INT1);
+        writeRegister(LIS3DH_REG_INT1_THS, LIS3DH_VAL_INT1_THS);
+        writeRegister(LIS3DH_REG_CTRL_REG1, LIS3DH_VAL_LOW_POWER_10HZ);
+        isActive();
+        writeRegister(LIS3DH_REG_INT1_CFG, LIS3DH_VAL_INT1_HIGH_XYZ);
+    }
+
+    static bool isActive(void)
+    {
+        uint8_t source = 0;
+        WIRE::readWithCommand(LIS3DH_I2C_ADDR, LIS3DH_REG_INT1_SRC, &source, 1);
+        return source & LIS3DH_VAL_INT1_ACTIVE;
+    }
+
+    static void disarmActivity(void)
+    {
+        writeRegister(LIS3DH_REG_INT1_CFG, 0);
+        writeRegister(LIS3DH_REG_CTRL_REG2, 0);
+        writeRegister(LIS3DH_REG_CTRL_REG1, LIS3DH_VAL_NORMAL_25HZ);
+    }
+
+private:
+    static int8_t offsets[3];
+
+    static void writeRegister(uint8_t reg, uint8_t value)
+    {
+        WIRE::writeWithCommand(LIS3DH_I2C_ADDR, reg, &value, 1);
+    }
+};
+
+template<class WIRE> int8_t LIS3DH<WIRE>::offsets[3];
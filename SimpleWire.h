@@ -114,6 +114,11 @@
   #define SimpleWire_SDA_LOW  SimpleWire_SDA(DDR)  |=  _BV(SimpleWire_SDA_POS)
 #endif
 #define SimpleWire_SDA_READ (SimpleWire_SDA(PIN) & _BV(SimpleWire_SDA_POS))
+#define SimpleWire_SCL_READ (SimpleWire_SCL(PIN) & _BV(SimpleWire_SCL_POS))
+
+#ifndef SimpleWire_TIMEOUT
+  #define SimpleWire_TIMEOUT 255 // polling count to wait for SCL release
+#endif
 
 #define SimpleWire_DELAY(t) \
 do { \
@@ -216,12 +221,15 @@ class SimpleWire
 {
   private:
 
-    static void start(void)
+    static bool start(void)
     {
+      if (!(SimpleWire_SDA_READ && SimpleWire_SCL_READ) && !recover())
+        return false;
       SimpleWire_SDA_LOW;
       SimpleWire_DELAY_THDSTA(MODE);
       SimpleWire_SCL_LOW;
       SimpleWire_DELAY_THDDAT(MODE);
+      return true;
     }
 
     static void stop(void)
@@ -251,8 +259,15 @@ class SimpleWire
       SimpleWire_SDA_HIGH;
       SimpleWire_DELAY_TLOW(MODE);
       SimpleWire_SCL_HIGH;
-      SimpleWire_DELAY_THIGH(MODE);
-      b = SimpleWire_SDA_READ;
+      if (waitScl())
+      {
+        SimpleWire_DELAY_THIGH(MODE);
+        b = SimpleWire_SDA_READ;
+        if (b && nackCount < 255)
+          ++nackCount;
+      }
+      else
+        b = 1;
       SimpleWire_SCL_LOW;
       SimpleWire_DELAY_THDDAT(MODE);
       return b;
@@ -281,6 +296,23 @@ class SimpleWire
       return b;
     }
 
+    /*  The functional enhancement by OBONO  */
+    static bool waitScl(void)
+    {
+      // wait for clock stretching by the slave
+      for (uint8_t t = SimpleWire_TIMEOUT; !SimpleWire_SCL_READ; )
+      {
+        if (--t == 0)
+        {
+          if (timeoutCount < 255)
+            ++timeoutCount;
+          return false;
+        }
+      }
+      return true;
+    }
+    /*  The end of the functional enhancement  */
+
   public:
 
     SimpleWire(void)
@@ -302,10 +334,8 @@ class SimpleWire
     static int write(uint8_t addr, const uint8_t *buf, uint8_t len)
     {
       int cnt = -1;
-      // start
-      start();
-      // write slave address
-      if (write((addr << 1) | SimpleWire_WRITE) == 0)
+      // start and write slave address
+      if (start() && write((addr << 1) | SimpleWire_WRITE) == 0)
       {
         // write data
         for (cnt = 0; cnt < len; ++cnt)
@@ -322,10 +352,8 @@ class SimpleWire
     static int read(uint8_t addr, uint8_t *buf, uint8_t len)
     {
       int cnt = -1;
-      // start
-      start();
-      // write slave address
-      if (write((addr << 1) | SimpleWire_READ) == 0)
+      // start and write slave address
+      if (start() && write((addr << 1) | SimpleWire_READ) == 0)
       {
         // read data
         for (cnt = 0; cnt < len; ++cnt)
@@ -337,13 +365,38 @@ class SimpleWire
     }
 
     /*  The functional enhancement by OBONO  */
+    // saturated fault counts, shown in the test mode
+    static uint8_t nackCount;
+    static uint8_t timeoutCount;
+    static uint8_t recoveryCount;
+
+    static bool recover(void)
+    {
+      if (recoveryCount < 255)
+        ++recoveryCount;
+      // clock out a slave holding SDA low, then issue stop
+      SimpleWire_SDA_HIGH;
+      SimpleWire_SCL_HIGH;
+      for (uint8_t i = 0; i < 9 && !SimpleWire_SDA_READ; ++i)
+      {
+        SimpleWire_SCL_LOW;
+        SimpleWire_DELAY_TLOW(MODE);
+        SimpleWire_SCL_HIGH;
+        if (!waitScl())
+          return false;
+        SimpleWire_DELAY_THIGH(MODE);
+      }
+      SimpleWire_SCL_LOW;
+      SimpleWire_DELAY_THDDAT(MODE);
+      stop();
+      return SimpleWire_SDA_READ && SimpleWire_SCL_READ;
+    }
+
     static int writeWithCommand(uint8_t addr, const uint8_t cmd, const uint8_t *buf = NULL, uint8_t len = 0)
     {
       int cnt = -1;
-      // start
-      start();
-      // write slave address and command
-      if (write((addr << 1) | SimpleWire_WRITE) == 0 && write(cmd) == 0)
+      // start and write slave address and command
+      if (start() && write((addr << 1) | SimpleWire_WRITE) == 0 && write(cmd) == 0)
       {
         // write data
         for (cnt = 0; cnt < len; ++cnt)
@@ -359,10 +412,8 @@ class SimpleWire
 
     static int readWithCommand(uint8_t addr, const uint8_t cmd, uint8_t *buf, uint8_t len)
     {
-      // start
-      start();
-      // write slave address and command
-      bool ret = (write((addr << 1) | SimpleWire_WRITE) == 0 && write(cmd) == 0);
+      // start and write slave address and command
+      bool ret = (start() && write((addr << 1) | SimpleWire_WRITE) == 0 && write(cmd) == 0);
       // stop
       stop();
       return (ret) ? read(addr, buf, len) : -1;
@@ -370,6 +421,12 @@ class SimpleWire
     /*  The end of the functional enhancement  */
 };
 
+/*  The functional enhancement by OBONO  */
+template<uint8_t MODE> uint8_t SimpleWire<MODE>::nackCount = 0;
+template<uint8_t MODE> uint8_t SimpleWire<MODE>::timeoutCount = 0;
+template<uint8_t MODE> uint8_t SimpleWire<MODE>::recoveryCount = 0;
+/*  The end of the functional enhancement  */
+
 template<uint8_t MODE = SimpleWire_100K, uint8_t BUFFER_LENGTH = 32>
 class TwoWire
 {
@@ -6,6 +6,8 @@
 
 #define BOARD_SIZE          4
 #define MILLIS_PER_FRAME    50
+#define MILLIS_PER_REFRESH  10
+#define SOUND_VALUE_PREEMPT 255
 
 /*  Global Functions  */
 
@@ -13,9 +15,13 @@ void initDevices(void);
 void manageConfigByButton(void);
 void getDPad(int8_t &vx, int8_t &vy);
 void refreshPixels(void);
-void playTone(uint16_t frequency, uint16_t duration = MILLIS_PER_FRAME, uint8_t value = 0);
+bool waitNextFrame(bool isAnimating);
+void playTone(uint16_t frequency, uint16_t duration = MILLIS_PER_FRAME);
 void playScore(const uint8_t *pScore, uint8_t value = 0);
+uint16_t getStackMargin(void);
+bool isHintEnabled(void);
 
 void initGame(void);
 void updateGame(int8_t vx, int8_t vy);
+bool animateGame(void);
 void getGamePixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b);
@@ -4,62 +4,101 @@
 #define SimpleWire_SDA_PORT B
 #define SimpleWire_SDA_POS  1
 #include "SimpleWire.h"
+#include "Accelerometer.h"
 #include <Adafruit_NeoPixel.h>
 #include <EEPROM.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
 
 /*  Defines  */
 
+enum : uint8_t {
+    BUTTON_NONE = 0,
+    BUTTON_SHORT,
+    BUTTON_LONG,
+    BUTTON_DOUBLE,
+};
+
 #define BUTTON_PIN          0
-#define BUTTON_FRAMES_SOUND 20 // 1 second
-#define BUTTON_FRAMES_SAVE  100 // 5 seconds
-
-#define ADXL345_I2C_ADDR            0x53
-#define ADXL345_REG_OFSX            0x1E
-#define ADXL345_REG_BW_RATE         0x2C
-#define ADXL345_REG_POWER_CTL       0x2D
-#define ADXL345_REG_DATA_FORMAT     0x31
-#define ADXL345_REG_DATAX0          0x32
-#define ADXL345_VAL_LOW_POWER_25HZ  0x18
-#define ADXL345_VAL_FULL_RES_2G     0x08
-#define ADXL345_VAL_MEASURE         0x08
+#define BUTTON_QUEUE_SIZE   4
+#define BUTTON_MILLIS_BOUNCE    20
+#define BUTTON_MILLIS_DOUBLE    300
+#define BUTTON_MILLIS_SOUND     1000
+#define BUTTON_MILLIS_SAVE      5000
+#define SLEEP_FRAMES        1200 // 1 minute
 
 #define TILT_ON             80
 #define TILT_OFF            30
 #define TILT_1G             256
 #define TILT_TOLERANCE      24
 #define TILT_OFFSET_SAMPLES 32
+#define TILT_REFINE_SAMPLES 64
+#define TILT_REFINE_LIMIT   16
+#define TILT_REFINE_RANGE   2 // Offset LSBs around the calibration
+#define TILT_ERRORS_RECOVER 3
+#define TILT_LEAD_MAX       32 // Fast steps from TILT_ON - TILT_LEAD_MAX fire
 
 #define PIXELS_PIN          3
 #define PIXELS_NUMBER       (BOARD_SIZE * BOARD_SIZE)
 #define BRIGHTNESS_MAX      4
+#define DITHER_PHASES       4
+#define MILLIS_PER_DITHER   3 // About 4 ms with the refresh itself, over 60 Hz for DITHER_PHASES
+
+#define VCC_MILLIS_MEASURE  1000
+#define VCC_MILLIS_SETTLE   1 // Bandgap start-up time
+#define VCC_BANDGAP_FACTOR  1126400UL // 1.1V * 1024 in millivolts
+#define VCC_LOW             3300 // mV
+#define VCC_HIGH            4200 // mV
+#define POWER_BUDGET_MIN    30 // mA
+#define POWER_BUDGET_MAX    200 // mA
+#define POWER_PER_CHANNEL   20 // mA at full intensity
 
 #define SPEAKER_PIN         4
 #define SPEAKER_PIN_PORT    B
 #define SPEAKER_PIN_POS     4
+#define SOUND_QUEUE_SIZE    4
+
+#define STACK_PAINT         0xC5
+#define STACK_MARGIN_SAFE   64
+#define STACK_MARGIN_LOW    32
 
 /*  Typedefs  */
 
 typedef SimpleWire<SimpleWire_1M> SimpleWire1M;
+typedef ADXL345<SimpleWire1M> Accelerometer; // or LIS3DH<SimpleWire1M>
 typedef void (*PixelFunc)(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b);
 
 /*  Local Functions  */
 
+static void acceptButtonEdge(uint16_t time);
+static void classifyButton(void);
+static void flushButton(void);
 static void readEEPROM(uint8_t address, uint8_t *pData, uint8_t len);
 static void writeEEPROM(uint8_t address, uint8_t *pData, uint8_t len);
 static void manageCalibration(int16_t x, int16_t y, int16_t z);
+static int16_t filterTilt(int16_t tilt, int16_t *pHistory);
 static void controlBrightness(void);
 static void toggleSound(void);
+static void toggleHint(void);
 static void saveConfig(void);
 static void getDPadPixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b);
 static void getDPadPixelSub(int8_t current, int8_t last, uint8_t &r, uint8_t &g, uint8_t &b);
+static uint8_t ditherChannel(uint8_t value, uint8_t level, uint8_t threshold);
 static void forwardSoundScore(void);
 static void setupSoundTimer(uint16_t frequency, uint16_t duration);
+static void settleVcc(void);
+static void measureVcc(void);
+static void powerDown(void);
+static void paintStack(void) __attribute__((naked, used, section(".init1")));
 
 /*  Local Functions (Macros)  */
 
 #define enableSoundTimer()      bitSet(TIMSK, OCIE1A)
-#define disableSoundTimer()     bitClear(TIMSK, OCIE1A)
+#define disableSoundTimer()     do { bitClear(TIMSK, OCIE1A); disconnectSpeaker(); } while (0)
 #define isSoundTimerActive()    bitRead(TIMSK, OCIE1A)
+#define connectSpeaker()        bitSet(GTCCR, COM1B0)
+#define disconnectSpeaker()     bitClear(GTCCR, COM1B0)
 
 /*  Local Constants  */
 
@@ -67,6 +106,10 @@ PROGMEM static const uint16_t noteFrequency[] = {
     8372, 8870, 9397, 9956, 10548, 11175, 11840, 12544, 13290, 14080, 14917, 15804
 };
 
+PROGMEM static const uint8_t ditherThresholds[DITHER_PHASES] = {
+    32, 160, 96, 224
+};
+
 PROGMEM static const uint8_t soundOn[] = {
     73, 10, 85, 10, 97, 10, 0xFF
 };
@@ -74,39 +117,69 @@ PROGMEM static const uint8_t soundOff[] = {
     94, 5, 70, 5, 0xFF
 };
 
+/*  External Variables  */
+
+extern uint8_t _end, __stack;
+extern char *__brkval;
+
 /*  Local Variables  */
 
 static Adafruit_NeoPixel pixels = Adafruit_NeoPixel(PIXELS_NUMBER, PIXELS_PIN, NEO_GRB + NEO_KHZ800);
 static int8_t lastVx, lastVy, currentVx, currentVy, brightness;
-static bool isSoundEnable, isCalibrated;
+static int8_t offsets[3], calibratedOffsets[3];
+static bool isSoundEnable, isHintEnable, isCalibrated, isDithering;
+static uint16_t idleFrames, pixelSum;
+static uint32_t powerLimit;
+
+static uint8_t buttonEvents[BUTTON_QUEUE_SIZE], buttonEventHead, buttonEventCount;
+static uint16_t pressTime, releaseTime;
+static bool isButtonHeld, isLongPressed, isShortPending, isSavePending;
+
+static volatile uint16_t buttonEdgeTimes[BUTTON_QUEUE_SIZE], lastEdgeTime;
+static volatile uint8_t buttonEdgeHead, buttonEdgeTail;
+static volatile bool isButtonPressed;
 
 static volatile uint32_t toneToggleCount;
 static volatile const uint8_t *pSoundScore;
-static volatile uint8_t soundValue;
+static const uint8_t *volatile soundQueue[SOUND_QUEUE_SIZE];
+static const uint8_t *volatile pSoundPreempt;
+static volatile uint8_t soundHead, soundTail;
+static volatile bool isSoundPreempted;
 
 /*---------------------------------------------------------------------------*/
 
 void initDevices(void)
 {
-    uint8_t data[4];
-    readEEPROM(0, data, 4);
+    uint8_t data[5];
+    readEEPROM(0, data, 5);
+    memcpy(offsets, data, 3);
+    memcpy(calibratedOffsets, data, 3);
+    for (uint8_t i = 0; i < 2; i++) {
+        int8_t refinement = (data[4] >> (i * 4) & 0x0F) - TILT_REFINE_RANGE;
+        if (abs(refinement) <= TILT_REFINE_RANGE) offsets[i] += refinement; // Erased one is ignored
+    }
     brightness = data[3] & 0x03;
     isSoundEnable = data[3] & 0x80;
+    isHintEnable = !(data[3] & 0x40); // Stored inverted, to be off on an erased EEPROM
 
     /*  Button  */
     pinMode(BUTTON_PIN, INPUT_PULLUP);
+    isButtonPressed = (digitalRead(BUTTON_PIN) == LOW);
+    flushButton();
+    bitSet(PCMSK, BUTTON_PIN);
+    bitSet(GIMSK, PCIE);
 
     /*  Accelerometer  */
     SimpleWire1M::begin();
-    SimpleWire1M::writeWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_OFSX, data, 3);
-    data[0] = ADXL345_VAL_LOW_POWER_25HZ;
-    data[1] = ADXL345_VAL_MEASURE;
-    SimpleWire1M::writeWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_BW_RATE, data, 2);
-    data[0] = ADXL345_VAL_FULL_RES_2G;
-    SimpleWire1M::writeWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_DATA_FORMAT, data, 1);
+    Accelerometer::begin(offsets);
     currentVx = currentVy = 0;
     isCalibrated = false;
 
+    /*  Supply Voltage  */
+    ADMUX = _BV(MUX3) | _BV(MUX2); // Measure the bandgap against VCC
+    settleVcc();
+    measureVcc();
+
     /*  NeoPixel  */
     pixels.begin();
     pixels.fill(pixels.Color(1, 1, 1));
@@ -119,44 +192,78 @@ void initDevices(void)
     pinMode(SPEAKER_PIN, OUTPUT);
     digitalWrite(SPEAKER_PIN, LOW);
     disableSoundTimer();
-    soundValue = 0;
+    soundHead = soundTail = 0;
+    isSoundPreempted = false;
 
     /*  Random Seed  */
-    SimpleWire1M::readWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_DATAX0, data, 4);
-    randomSeed((unsigned long)*data);
+    int16_t x = offsets[0], y, z; // Kept as the old seed when the read fails
+    Accelerometer::read(x, y, z);
+    randomSeed((unsigned long)x);
 }
 
 void getDPad(int8_t &vx, int8_t &vy)
 {
+    static uint8_t errors = 0;
+    static int16_t historyX[3], historyY[3], tiltX = 0, tiltY = 0;
     lastVx = currentVx;
     lastVy = currentVy;
-    uint8_t dac[6];
-    if (!isSoundTimerActive() && SimpleWire1M::readWithCommand(
-            ADXL345_I2C_ADDR, ADXL345_REG_DATAX0, dac, sizeof(dac)) > 0) {
-        int16_t x = (dac[1] << 8) | dac[0];
-        int16_t y = (dac[3] << 8) | dac[2];
-        int16_t z = (dac[5] << 8) | dac[4];
+    int16_t x, y, z;
+    if (Accelerometer::read(x, y, z)) {
         if (!isCalibrated) manageCalibration(x, y, z);
-        int16_t tiltX = y, tiltY = x; // Convert to real coordinates
+        tiltX = filterTilt(y, historyX); // Convert to real coordinates
+        tiltY = filterTilt(x, historyY);
         if (lastVx < 0 && tiltX >= -TILT_OFF || lastVx > 0 && tiltX <= TILT_OFF) currentVx = 0;
         if (tiltX <= -TILT_ON) currentVx = -1;
         if (tiltX >= TILT_ON) currentVx = 1;
         if (lastVy < 0 && tiltY >= -TILT_OFF || lastVy > 0 && tiltY <= TILT_OFF) currentVy = 0;
         if (tiltY <= -TILT_ON) currentVy = -1;
         if (tiltY >= TILT_ON) currentVy = 1;
+        errors = 0;
+    } else if (++errors >= TILT_ERRORS_RECOVER) {
+        SimpleWire1M::recover();
+        Accelerometer::begin(offsets);
+        currentVx = currentVy = 0;
+        errors = 0;
     }
+    if (currentVx != lastVx || currentVy != lastVy) idleFrames = 0;
     vx = (!isCalibrated && currentVx != lastVx) ? currentVx : 0;
     vy = (!isCalibrated && currentVy != lastVy) ? currentVy : 0;
+    if (vx != 0 && vy != 0) {
+        if (abs(tiltX) >= abs(tiltY)) {
+            vy = 0;
+        } else {
+            vx = 0;
+        }
+    }
 }
 
 void refreshPixels(void)
 {
+    static uint32_t vccTime = 0;
+    if (millis() - vccTime >= VCC_MILLIS_MEASURE) {
+        measureVcc();
+        vccTime = millis();
+    }
+
+    /*  Cap the brightness by the estimated current of the last frame  */
+    uint8_t level = brightness << 6 | 0x3F;
+    if (pixelSum > 0 && powerLimit / pixelSum < level) level = powerLimit / pixelSum;
+
+    static uint8_t phase = 0;
+    phase++;
     PixelFunc func = (isCalibrated) ? getDPadPixel : getGamePixel;
+    pixelSum = 0;
+    isDithering = false;
     for (uint8_t i = 0; i < PIXELS_NUMBER; i++) {
         int8_t x = i % BOARD_SIZE, y = i / BOARD_SIZE;
         if (y & 1) x = BOARD_SIZE - 1 - x;
         uint8_t r, g, b;
         func(x, y, r, g, b);
+        pixelSum += r + g + b;
+        uint8_t threshold = pgm_read_byte(&ditherThresholds[(phase + i) % DITHER_PHASES]);
+        r = ditherChannel(r, level, threshold);
+        g = ditherChannel(g, level, threshold);
+        b = ditherChannel(b, level, threshold);
         pixels.setPixelColor(i, r, g, b);
     }
     pixels.show();
@@ -164,42 +271,175 @@ void refreshPixels(void)
 
 void manageConfigByButton(void)
 {
-    static uint8_t hold = BUTTON_FRAMES_SOUND, idle = BUTTON_FRAMES_SAVE;
-    if (digitalRead(BUTTON_PIN) == LOW) {
-        if (isCalibrated) isCalibrated = false, hold = BUTTON_FRAMES_SOUND;
-        if (hold < BUTTON_FRAMES_SOUND && ++hold == BUTTON_FRAMES_SOUND) toggleSound();
-        idle = 0;
-    } else {
-        if (hold > 0 && hold < BUTTON_FRAMES_SOUND) controlBrightness();
-        if (idle < BUTTON_FRAMES_SAVE && ++idle == BUTTON_FRAMES_SAVE) saveConfig();
-        hold = 0;
+    classifyButton();
+    while (buttonEventCount > 0) {
+        uint8_t event = buttonEvents[buttonEventHead];
+        buttonEventHead = (buttonEventHead + 1) % BUTTON_QUEUE_SIZE;
+        buttonEventCount--;
+        switch (event) {
+            case BUTTON_SHORT:
+                controlBrightness();
+                break;
+            case BUTTON_LONG:
+                toggleSound();
+                break;
+            case BUTTON_DOUBLE:
+                toggleHint();
+                break;
+            default:
+                break;
+        }
+    }
+    if (isSavePending && !isButtonHeld && (uint16_t)millis() - releaseTime >= BUTTON_MILLIS_SAVE) {
+        saveConfig();
+        isSavePending = false;
     }
 }
 
-void playTone(uint16_t frequency, uint16_t duration, uint8_t value)
+bool waitNextFrame(bool isAnimating)
 {
-    if (isSoundEnable && value >= soundValue) {
-        disableSoundTimer();
+    static uint32_t frameTime = 0;
+    static bool isFrame = true;
+    if (isFrame) {
+        if (++idleFrames >= SLEEP_FRAMES && !isSoundTimerActive()) {
+            powerDown();
+            idleFrames = 0;
+            frameTime = millis();
+        }
+        frameTime += MILLIS_PER_FRAME;
+        if ((int32_t)(millis() - frameTime) > 0) frameTime = millis(); // Frame overrun
+    }
+    uint32_t wakeTime = millis() + ((isDithering) ? MILLIS_PER_DITHER : MILLIS_PER_REFRESH);
+    if (!isAnimating && !isDithering || (int32_t)(wakeTime - frameTime) > 0) wakeTime = frameTime;
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while ((int32_t)(millis() - wakeTime) < 0) sleep_mode();
+    isFrame = (wakeTime == frameTime);
+    return isFrame;
+}
+
+void playTone(uint16_t frequency, uint16_t duration)
+{
+    if (isSoundEnable && !isSoundTimerActive()) {
         pSoundScore = NULL;
-        soundValue = value;
         setupSoundTimer(frequency, duration);
     }
 }
 
 void playScore(const uint8_t *pScore, uint8_t value)
 {
-    if ((isSoundEnable || pScore == soundOff) && value >= soundValue) {
-        disableSoundTimer();
-        pSoundScore = pScore;
-        if (pScore != NULL) {
-            soundValue = value;
+    static const uint8_t *pLastScore = NULL;
+    if (!(isSoundEnable || pScore == soundOff) || pScore == NULL) return;
+    if (value >= SOUND_VALUE_PREEMPT) {
+        /*  Handed to the ISR, which switches to it at the next toggle  */
+        while (isSoundPreempted && isSoundTimerActive()) {}
+        pSoundPreempt = pScore;
+        isSoundPreempted = true;
+        if (!isSoundTimerActive()) {
+            /*  The ISR is off, so the consumer side can be taken over here  */
+            isSoundPreempted = false;
+            soundHead = soundTail;
+            pSoundScore = pScore;
             forwardSoundScore();
         }
+    } else {
+        /*  Coalesce the repeated lowest priority one, such as moving  */
+        if (value == 0 && pScore == pLastScore && (isSoundTimerActive() || soundHead != soundTail)) return;
+        uint8_t tail = (soundTail + 1) % SOUND_QUEUE_SIZE;
+        if (tail == soundHead) return; // Queue full
+        soundQueue[soundTail] = pScore;
+        soundTail = tail;
+        if (!isSoundTimerActive()) forwardSoundScore(); // Likewise, as the consumer
     }
+    pLastScore = pScore;
+}
+
+uint16_t getStackMargin(void)
+{
+    /*  Count the paint left between the heap and the deepest stack so far  */
+    const uint8_t *p = (__brkval != NULL) ? (const uint8_t *)__brkval : &_end;
+    uint16_t margin = 0;
+    while (p <= &__stack && *p++ == STACK_PAINT) margin++;
+    return margin;
+}
+
+bool isHintEnabled(void)
+{
+    return isHintEnable;
 }
 
 /*---------------------------------------------------------------------------*/
 
+static void acceptButtonEdge(uint16_t time)
+{
+    uint8_t tail = (buttonEdgeTail + 1) % BUTTON_QUEUE_SIZE;
+    if (tail == buttonEdgeHead) return;
+    isButtonPressed = !isButtonPressed;
+    lastEdgeTime = time;
+    buttonEdgeTimes[buttonEdgeTail] = time;
+    buttonEdgeTail = tail;
+}
+
+static void classifyButton(void)
+{
+    uint16_t now = millis();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        /*  Settle the level where a bounce has been ignored  */
+        if ((digitalRead(BUTTON_PIN) == LOW) != isButtonPressed &&
+                now - lastEdgeTime >= BUTTON_MILLIS_BOUNCE) acceptButtonEdge(now);
+    }
+    while (buttonEdgeHead != buttonEdgeTail) {
+        uint16_t time = buttonEdgeTimes[buttonEdgeHead];
+        buttonEdgeHead = (buttonEdgeHead + 1) % BUTTON_QUEUE_SIZE;
+        isButtonHeld = !isButtonHeld;
+        idleFrames = 0;
+        uint8_t event = BUTTON_NONE;
+        if (isButtonHeld) {
+            if (isCalibrated) {
+                isCalibrated = false; // Exit the test mode at the press, without any event
+                isLongPressed = true;
+            } else if (isShortPending && time - releaseTime < BUTTON_MILLIS_DOUBLE) {
+                event = BUTTON_DOUBLE;
+                isLongPressed = true; // Not to be classified again on release
+            } else {
+                isLongPressed = false;
+            }
+            isShortPending = false;
+            pressTime = time;
+        } else {
+            isShortPending = !isLongPressed;
+            isSavePending = true;
+            releaseTime = time;
+        }
+        if (event != BUTTON_NONE && buttonEventCount < BUTTON_QUEUE_SIZE) {
+            buttonEvents[(buttonEventHead + buttonEventCount++) % BUTTON_QUEUE_SIZE] = event;
+        }
+    }
+    uint8_t event = BUTTON_NONE;
+    if (isButtonHeld && !isLongPressed && now - pressTime >= BUTTON_MILLIS_SOUND) {
+        event = BUTTON_LONG;
+        isLongPressed = true;
+    }
+    if (isShortPending && now - releaseTime >= BUTTON_MILLIS_DOUBLE) {
+        event = BUTTON_SHORT;
+        isShortPending = false;
+    }
+    if (event != BUTTON_NONE && buttonEventCount < BUTTON_QUEUE_SIZE) {
+        buttonEvents[(buttonEventHead + buttonEventCount++) % BUTTON_QUEUE_SIZE] = event;
+    }
+    if (isButtonHeld) idleFrames = 0;
+}
+
+static void flushButton(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        buttonEdgeHead = buttonEdgeTail;
+        isButtonHeld = isButtonPressed;
+    }
+    isLongPressed = true;
+    isShortPending = false;
+    buttonEventCount = 0;
+}
+
 static void readEEPROM(uint8_t address, uint8_t *pData, uint8_t len)
 {
     while (len--) *pData++ = EEPROM.read(address++);
@@ -213,48 +453,93 @@ static void writeEEPROM(uint8_t address, uint8_t *pData, uint8_t len)
 static void manageCalibration(int16_t x, int16_t y, int16_t z)
 {
     static int16_t lastX = 0, lastY = 0, lastZ = 0;
-    static int16_t offsetX = 0, offsetY = 0, offsetZ = 0;
+    static int16_t sums[3];
+    static int8_t lastFace = 0;
     static uint8_t samples = 0;
-    if (z < -TILT_1G / 2 &&
+
+    /*  Upside down for the calibration, or resting level for the refinement  */
+    int8_t face = 0;
+    if (z < -TILT_1G / 2) face = -1;
+    if (z > TILT_1G / 2 && abs(x) < TILT_REFINE_LIMIT && abs(y) < TILT_REFINE_LIMIT) face = 1;
+    if (face != 0 && face == lastFace &&
         abs(x - lastX) + abs(y - lastY) + abs(z - lastZ) < TILT_TOLERANCE) {
-        offsetX += x;
-        offsetY += y;
-        offsetZ += z + TILT_1G;
-        if (++samples == TILT_OFFSET_SAMPLES) {
-            uint8_t data[3];
-            readEEPROM(0, data, 3);
-            data[0] -= offsetX / TILT_OFFSET_SAMPLES / 4;
-            data[1] -= offsetY / TILT_OFFSET_SAMPLES / 4;
-            data[2] -= offsetZ / TILT_OFFSET_SAMPLES / 4;
-            SimpleWire1M::writeWithCommand(ADXL345_I2C_ADDR, ADXL345_REG_OFSX, data, 3);
-            writeEEPROM(0, data, 3);
+        sums[0] += x;
+        sums[1] += y;
+        sums[2] += z - face * TILT_1G;
+        samples++;
+        if (face < 0 && samples == TILT_OFFSET_SAMPLES) {
+            for (uint8_t i = 0; i < 3; i++) {
+                offsets[i] -= sums[i] / TILT_OFFSET_SAMPLES / (1 << Accelerometer::OFFSET_SHIFT);
+            }
+            Accelerometer::writeOffsets(offsets);
+            writeEEPROM(0, (uint8_t *)offsets, 3);
+            memcpy(calibratedOffsets, offsets, 3);
+            saveConfig();
             isCalibrated = true;
+            samples = 0;
+        }
+        if (face > 0 && samples == TILT_REFINE_SAMPLES) {
+            /*  Step X and Y by one LSB at most near the calibration, and store it lazily by saveConfig()  */
+            for (uint8_t i = 0; i < 2; i++) {
+                int8_t step = constrain(sums[i] / TILT_REFINE_SAMPLES / (1 << Accelerometer::OFFSET_SHIFT), -1, 1);
+                offsets[i] = constrain(offsets[i] - step, calibratedOffsets[i] - TILT_REFINE_RANGE,
+                        calibratedOffsets[i] + TILT_REFINE_RANGE);
+            }
+            Accelerometer::writeOffsets(offsets);
+            samples = 0;
         }
-    } else if (samples > 0){
-        offsetX = offsetY = offsetZ = 0;
+    } else {
         samples = 0;
     }
+    if (samples == 0) memset(sums, 0, sizeof(sums));
+    lastFace = face;
     lastX = x;
     lastY = y;
     lastZ = z;
 }
 
+static int16_t filterTilt(int16_t tilt, int16_t *pHistory)
+{
+    /*  The smaller of two agreeing samples, so that a single spike is rejected  */
+    int16_t agreed = 0;
+    if (tilt > 0 && pHistory[0] > 0) agreed = min(tilt, pHistory[0]);
+    if (tilt < 0 && pHistory[0] < 0) agreed = max(tilt, pHistory[0]);
+
+    /*  Led by its bounded rate over two samples, only away from level  */
+    int16_t lead = constrain(agreed - pHistory[2], -TILT_LEAD_MAX, TILT_LEAD_MAX);
+    pHistory[0] = tilt;
+    pHistory[2] = pHistory[1];
+    pHistory[1] = agreed;
+    if (agreed > 0 && lead > 0 || agreed < 0 && lead < 0) return agreed + lead;
+    return agreed;
+}
+
 void controlBrightness(void)
 {
     if (++brightness >= BRIGHTNESS_MAX) brightness = 0;
-    pixels.setBrightness(brightness << 6 | 0x3F);
 }
 
 void toggleSound(void)
 {
     isSoundEnable = !isSoundEnable;
-    playScore((isSoundEnable) ? soundOn : soundOff, 255);
+    playScore((isSoundEnable) ? soundOn : soundOff, SOUND_VALUE_PREEMPT);
+}
+
+void toggleHint(void)
+{
+    isHintEnable = !isHintEnable;
+    if (isSoundEnable) playScore((isHintEnable) ? soundOn : soundOff, SOUND_VALUE_PREEMPT);
 }
 
 static void saveConfig(void)
 {
-    uint8_t data = isSoundEnable << 7 | brightness;
-    writeEEPROM(3, &data, 1);
+    uint8_t data[2];
+    data[0] = isSoundEnable << 7 | !isHintEnable << 6 | brightness;
+    data[1] = 0;
+    for (uint8_t i = 0; i < 2; i++) {
+        data[1] |= (offsets[i] - calibratedOffsets[i] + TILT_REFINE_RANGE) << (i * 4);
+    }
+    writeEEPROM(3, data, 2);
 }
 
 static void getDPadPixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b)
@@ -267,7 +552,17 @@ static void getDPadPixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b)
     if (x > 0 && x < BOARD_SIZE - 1) {
         if (y == 0) getDPadPixelSub(-currentVy, -lastVy, r, g, b);
         if (y == BOARD_SIZE - 1) getDPadPixelSub(currentVy, lastVy, r, g, b);
+        if (y > 0 && y < BOARD_SIZE - 1) {
+            uint16_t margin = getStackMargin();
+            if (margin < STACK_MARGIN_SAFE) r = 4;
+            if (margin >= STACK_MARGIN_LOW) g = 4;
+        }
     }
+
+    /*  The corner lights show the I2C faults so far  */
+    if (x == 0 && y == 0 && SimpleWire1M::nackCount > 0) r = b = 4;
+    if (x == BOARD_SIZE - 1 && y == 0 && SimpleWire1M::timeoutCount > 0) r = g = 4;
+    if (x == 0 && y == BOARD_SIZE - 1 && SimpleWire1M::recoveryCount > 0) r = 4;
 }
 
 static void getDPadPixelSub(int8_t current, int8_t last, uint8_t &r, uint8_t &g, uint8_t &b)
@@ -283,13 +578,25 @@ static void getDPadPixelSub(int8_t current, int8_t last, uint8_t &r, uint8_t &g,
     }
 }
 
+static uint8_t ditherChannel(uint8_t value, uint8_t level, uint8_t threshold)
+{
+    /*  Scale by the brightness level, carrying the fraction over the refreshes  */
+    uint16_t scaled = (uint16_t)value * (level + 1);
+    if (lowByte(scaled) != 0) isDithering = true;
+    return (scaled + threshold) >> 8;
+}
+
 static void forwardSoundScore(void)
 {
-    uint8_t note = pgm_read_byte(pSoundScore++);
-    if (bitRead(note, 7)) {
-        pSoundScore = NULL;
-        soundValue = 0;
-        return;
+    uint8_t note = (pSoundScore != NULL) ? pgm_read_byte(pSoundScore++) : 0xFF;
+    while (bitRead(note, 7)) {
+        if (soundHead == soundTail) {
+            pSoundScore = NULL;
+            return;
+        }
+        pSoundScore = soundQueue[soundHead];
+        soundHead = (soundHead + 1) % SOUND_QUEUE_SIZE;
+        note = pgm_read_byte(pSoundScore++);
     }
     uint16_t frequency = pgm_read_word(&noteFrequency[note % 12]);
     frequency >>= (131 - note) / 12;
@@ -307,24 +614,106 @@ static void setupSoundTimer(uint16_t frequency, uint16_t duration)
         ocr >>= 1;
     }
     TCCR1 = 0b10000000 | prescalarBits; // CTC1=1, PWM1A=0, COM1A=00
+    OCR1B = 0;
     OCR1C = ocr - 1;
     TCNT1 = 0;
+    connectSpeaker(); // OC1B toggles the speaker pin by hardware
+    bitSet(TIFR, OCF1A);
     enableSoundTimer();
 }
 
+static void settleVcc(void)
+{
+    /*  Wait for the bandgap to start and throw away the first conversion  */
+    delay(VCC_MILLIS_SETTLE);
+    bitSet(ADCSRA, ADSC);
+    loop_until_bit_is_clear(ADCSRA, ADSC);
+}
+
+static void measureVcc(void)
+{
+    bitSet(ADCSRA, ADSC);
+    loop_until_bit_is_clear(ADCSRA, ADSC);
+    uint16_t vcc = VCC_BANDGAP_FACTOR / ADC;
+    uint16_t budget;
+    if (vcc <= VCC_LOW) {
+        budget = POWER_BUDGET_MIN;
+    } else if (vcc >= VCC_HIGH) {
+        budget = POWER_BUDGET_MAX;
+    } else {
+        budget = POWER_BUDGET_MIN + (uint32_t)(vcc - VCC_LOW) *
+                (POWER_BUDGET_MAX - POWER_BUDGET_MIN) / (VCC_HIGH - VCC_LOW);
+    }
+    powerLimit = (uint32_t)budget * 255 * 255 / POWER_PER_CHANNEL; // Limit of sum * level
+}
+
+static void powerDown(void)
+{
+    /*  Blank the display and arm the activity detection  */
+    saveConfig();
+    pixels.clear();
+    pixels.show();
+    Accelerometer::armActivity();
+    bitClear(ADCSRA, ADEN);
+
+    /*  The INT pin of the accelerometer isn't wired, so poll it at each watchdog wake-up  */
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    do {
+        cli();
+        WDTCR = _BV(WDCE) | _BV(WDE);
+        WDTCR = _BV(WDIE) | _BV(WDP2) | _BV(WDP0); // 0.5 seconds
+        sei();
+        sleep_mode();
+    } while (digitalRead(BUTTON_PIN) == HIGH && !Accelerometer::isActive());
+    wdt_disable();
+
+    /*  Restore  */
+    bitSet(ADCSRA, ADEN);
+    settleVcc();
+    measureVcc();
+    Accelerometer::disarmActivity();
+    refreshPixels();
+    while (digitalRead(BUTTON_PIN) == LOW) delay(MILLIS_PER_FRAME); // Swallow the wake-up press
+    delay(BUTTON_MILLIS_BOUNCE);
+    flushButton();
+}
+
+static void paintStack(void)
+{
+    /*  Runs before .init2 sets up r1 and SP, so fill all the free SRAM in assembly  */
+    __asm__ __volatile__ (
+        "    ldi r30, lo8(_end)\n"
+        "    ldi r31, hi8(_end)\n"
+        "    ldi r24, %0\n"
+        "    ldi r25, hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:  st Z+, r24\n"
+        "2:  cpi r30, lo8(__stack)\n"
+        "    cpc r31, r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n"
+        :: "M" (STACK_PAINT)
+    );
+}
+
+EMPTY_INTERRUPT(WDT_vect);
+ISR(PCINT0_vect)
+{
+    uint16_t now = millis();
+    if ((digitalRead(BUTTON_PIN) == LOW) != isButtonPressed &&
+            now - lastEdgeTime >= BUTTON_MILLIS_BOUNCE) acceptButtonEdge(now);
+}
+
 ISR(TIMER1_COMPA_vect)
 {
-    if (toneToggleCount > 0) {
-        if (--toneToggleCount) {
-            PORTB ^= _BV(SPEAKER_PIN_POS);
-        } else {
-            PORTB &= ~_BV(SPEAKER_PIN_POS);
-            disableSoundTimer();
-            if (pSoundScore != NULL) {
-                forwardSoundScore();
-            } else {
-                soundValue = 0;
-            }
-        }
+    if (isSoundPreempted) {
+        soundHead = soundTail;
+        pSoundScore = pSoundPreempt;
+        isSoundPreempted = false;
+        toneToggleCount = 1;
+    }
+    if (toneToggleCount > 0 && --toneToggleCount == 0) {
+        disableSoundTimer();
+        forwardSoundScore();
     }
 }
@@ -10,9 +10,33 @@ enum : uint8_t {
 
 #define TILE_MAX    11
 
+#define SLIDE_MILLIS    100
+#define SLIDE_STEPS     16
+
+#define GESTURE_QUEUE_SIZE  4
+#define GESTURE_MILLIS_MAX  600
+
+#define HINT_MILLIS_IDLE    3000
+#define HINT_DIRS           4
+#define HINT_PLIES          3
+#define HINT_SCORE_NONE     -1
+#define HINT_SCORE_EMPTY    8
+#define HINT_SCORE_PAIR     3
+#define HINT_SCORE_CORNER   4
+
+/*  Typedefs  */
+
+typedef struct {
+    int8_t vx, vy;
+    uint16_t time;
+} Gesture;
+
 /*  Local Functions  */
 
 static void initBoard(void);
+static void pushGesture(int8_t vx, int8_t vy);
+static bool popGesture(int8_t &vx, int8_t &vy);
+static bool startMove(void);
 static int8_t getTile(int8_t x, int8_t y);
 static void setTile(int8_t x, int8_t y, int8_t tile);
 static void addRandomTile(void);
@@ -20,11 +44,20 @@ static void prepareTiles(void);
 static bool moveTiles(int8_t vx, int8_t vy);
 static void updateTiles(void);
 static bool isGameOver(void);
+static void getSlidePixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b);
+static void resetHint(void);
+static void updateHint(void);
+static int16_t searchHint(const int8_t *pBoard, int8_t dir, int8_t plies);
+static bool slideBoard(int8_t *pBoard, int8_t vx, int8_t vy);
+static int16_t evaluateBoard(const int8_t *pBoard);
+static bool isHintPixel(int8_t x, int8_t y);
 
 /*  Local Functions (Macros)  */
 
 #define setMerged(x, y)     bitSet(mergedFlags, (y) * BOARD_SIZE + (x))
 #define isMerged(x, y)      bitRead(mergedFlags, (y) * BOARD_SIZE + (x))
+#define hintVx(dir)         (((dir) & 2) ? 0 : ((dir) & 1) * 2 - 1)
+#define hintVy(dir)         (((dir) & 2) ? ((dir) & 1) * 2 - 1 : 0)
 
 /*  Local Constants  */
 
@@ -81,9 +114,14 @@ PROGMEM static const uint8_t *const soundMergeTable[] = {
 /*  Local Variables  */
 
 static int8_t board[BOARD_SIZE][BOARD_SIZE];
-static uint16_t mergedFlags;
+static uint8_t slides[BOARD_SIZE][BOARD_SIZE]; // Source tile | distance << 4
+static uint16_t mergedFlags, slideTime;
 static int8_t empty, state, moveVx, moveVy, bestTile;
-static int8_t flash, addedX, addedY, blink;
+static int8_t flash, addedX, addedY, blink, slideProgress;
+static Gesture gestures[GESTURE_QUEUE_SIZE];
+static uint8_t gestureHead, gestureCount;
+static int8_t hintDir, hintStep;
+static int16_t hintScore;
 
 /*---------------------------------------------------------------------------*/
 
@@ -95,32 +133,22 @@ void initGame(void)
     prepareTiles();
     bestTile = 1;
     blink = 0;
+    gestureCount = 0;
+    slideTime = millis();
+    resetHint();
     state = STATE_IDLE;
     playScore(soundStart, TILE_MAX);
 }
 
 void updateGame(int8_t vx, int8_t vy)
 {
+    if (vx != 0 && vy == 0 || vx == 0 && vy != 0) pushGesture(vx, vy);
     switch (state) {
         case STATE_IDLE:
             if (flash > 0) flash--;
-            if (vx != 0 && vy == 0 || vx == 0 && vy != 0) {
-                prepareTiles();
-                if (moveTiles(vx, vy)) {
-                    moveVx = vx;
-                    moveVy = vy;
-                    state = STATE_MOVING;
-                    flash = 8;
-                }
-            }
+            if (!startMove() && isHintEnabled()) updateHint();
             break;
         case STATE_MOVING:
-            if (!moveTiles(moveVx, moveVy)) {
-                updateTiles();
-                addRandomTile();
-                state = (isGameOver()) ? STATE_OVER : STATE_IDLE;
-            }
-            break;
         case STATE_OVER:
         default:
             break;
@@ -128,8 +156,26 @@ void updateGame(int8_t vx, int8_t vy)
     blink = (blink + 1) % (TILE_MAX * 2);
 }
 
+bool animateGame(void)
+{
+    if (state != STATE_MOVING) return false;
+    uint16_t elapsed = (uint16_t)millis() - slideTime;
+    if (elapsed < SLIDE_MILLIS) {
+        slideProgress = elapsed * SLIDE_STEPS / SLIDE_MILLIS;
+        return true;
+    }
+    updateTiles();
+    addRandomTile();
+    state = (isGameOver()) ? STATE_OVER : STATE_IDLE;
+    return (state == STATE_IDLE && startMove());
+}
+
 void getGamePixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b)
 {
+    if (state == STATE_MOVING) {
+        getSlidePixel(x, y, r, g, b);
+        return;
+    }
     int8_t tile = getTile(x, y);
     if (tile >= 0 && tile <= TILE_MAX) {
         uint16_t color = pgm_read_word(&tileColors[tile]);
@@ -138,6 +184,7 @@ void getGamePixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b)
             if (tile != bestTile && blink <= 8) d = 5 - abs(4 - blink);
         } else {
             if (isMerged(x, y)) w = flash;
+            if (isHintPixel(x, y)) w += abs(TILE_MAX - blink) >> 1;
             if (tile == (blink >> 1) + 1 && (blink & 1) == 0) d = 1;
             if ((flash & 1) && x == addedX && y == addedY) d = (flash >> 1);
         }
@@ -155,6 +202,49 @@ static void initBoard(void)
     empty = BOARD_SIZE * BOARD_SIZE;
 }
 
+static void pushGesture(int8_t vx, int8_t vy)
+{
+    if (gestureCount == GESTURE_QUEUE_SIZE) return;
+    Gesture &gesture = gestures[(gestureHead + gestureCount++) % GESTURE_QUEUE_SIZE];
+    gesture.vx = vx;
+    gesture.vy = vy;
+    gesture.time = millis();
+}
+
+static bool popGesture(int8_t &vx, int8_t &vy)
+{
+    while (gestureCount > 0) {
+        Gesture &gesture = gestures[gestureHead];
+        gestureHead = (gestureHead + 1) % GESTURE_QUEUE_SIZE;
+        gestureCount--;
+        if ((uint16_t)millis() - gesture.time <= GESTURE_MILLIS_MAX) {
+            vx = gesture.vx;
+            vy = gesture.vy;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool startMove(void)
+{
+    int8_t vx, vy;
+    while (popGesture(vx, vy)) {
+        prepareTiles();
+        if (moveTiles(vx, vy)) {
+            moveVx = vx;
+            moveVy = vy;
+            slideTime = millis();
+            slideProgress = 0;
+            state = STATE_MOVING;
+            flash = 8;
+            resetHint();
+            return true;
+        }
+    }
+    return false;
+}
+
 static int8_t getTile(int8_t x, int8_t y)
 {
     return (x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE) ? board[y][x] : -1;
@@ -192,22 +282,27 @@ static bool moveTiles(int8_t vx, int8_t vy)
 {
     bool moved = false;
     for (int8_t i = 0; i < BOARD_SIZE; i++) {
+        int8_t dest = 0, lastTile = 0; // Index from the leading edge
         for (int8_t j = 0; j < BOARD_SIZE; j++) {
-            int8_t x = (vx > 0) ? BOARD_SIZE - 1 - j : j;
-            int8_t y = (vy > 0) ? BOARD_SIZE - 1 - i : i;
+            int8_t x = (vx == 0) ? i : (vx > 0) ? BOARD_SIZE - 1 - j : j;
+            int8_t y = (vy == 0) ? i : (vy > 0) ? BOARD_SIZE - 1 - j : j;
             int8_t tile = getTile(x, y);
+            slides[y][x] = tile;
             if (tile != 0) {
-                int8_t nextTile = getTile(x + vx, y + vy);
-                if (nextTile == 0) {
-                    setTile(x, y, 0);
-                    setTile(x + vx, y + vy, tile);
-                    moved = true;
-                } else if (nextTile == tile && !isMerged(x + vx, y + vy)) {
-                    setTile(x, y, 0);
-                    setMerged(x + vx, y + vy);
+                int8_t distance;
+                setTile(x, y, 0);
+                if (tile == lastTile) {
+                    distance = j - dest + 1;
+                    setMerged(x + vx * distance, y + vy * distance);
+                    lastTile = 0;
                     empty++;
-                    moved = true;
+                } else {
+                    distance = j - dest++;
+                    lastTile = tile;
                 }
+                setTile(x + vx * distance, y + vy * distance, tile);
+                slides[y][x] |= distance << 4;
+                if (distance > 0) moved = true;
             }
         }
     }
@@ -242,6 +337,121 @@ static bool isGameOver(void)
                 getTile(x, y - 1) == tile || getTile(x, y + 1) == tile) return false;
         }
     }
-    playScore(soundOver, TILE_MAX);
+    playScore(soundOver, SOUND_VALUE_PREEMPT);
     return true;
 }
+
+static void getSlidePixel(int8_t x, int8_t y, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+    r = g = b = 0;
+    int8_t pos = (moveVx != 0) ? x : y, sign = moveVx + moveVy;
+    for (int8_t i = 0; i < BOARD_SIZE; i++) {
+        uint8_t slide = (moveVx != 0) ? slides[y][i] : slides[i][x];
+        int8_t tile = slide & 0x0F;
+        if (tile == 0) continue;
+        int16_t gap = (i - pos) * SLIDE_STEPS + sign * (slide >> 4) * slideProgress;
+        uint8_t weight = (abs(gap) < SLIDE_STEPS) ? SLIDE_STEPS - abs(gap) : 0;
+        if (weight == 0) continue;
+        uint16_t color = pgm_read_word(&tileColors[tile]);
+        r = max(r, (uint8_t)(((color >> 7) & 0x1E) * weight / SLIDE_STEPS));
+        g = max(g, (uint8_t)(((color >> 3) & 0x1E) * weight / SLIDE_STEPS));
+        b = max(b, (uint8_t)(((color << 1) & 0x1E) * weight / SLIDE_STEPS));
+    }
+}
+
+/*  Hint: one root direction is searched per frame, on board copies in the stack  */
+
+static void resetHint(void)
+{
+    hintDir = -1;
+    hintStep = 0;
+    hintScore = HINT_SCORE_NONE;
+}
+
+static void updateHint(void)
+{
+    if (hintStep >= HINT_DIRS) return;
+    if (hintStep == 0 && (uint16_t)millis() - slideTime < HINT_MILLIS_IDLE) return;
+    int16_t score = searchHint(&board[0][0], hintStep, HINT_PLIES);
+    if (hintScore < score) {
+        hintScore = score;
+        hintDir = hintStep;
+    }
+    hintStep++;
+}
+
+static int16_t searchHint(const int8_t *pBoard, int8_t dir, int8_t plies)
+{
+    int8_t work[BOARD_SIZE * BOARD_SIZE];
+    memcpy(work, pBoard, sizeof(work));
+    if (!slideBoard(work, hintVx(dir), hintVy(dir))) return HINT_SCORE_NONE;
+    int16_t best = HINT_SCORE_NONE;
+    if (plies > 1) {
+        for (int8_t i = 0; i < HINT_DIRS; i++) {
+            int16_t score = searchHint(work, i, plies - 1);
+            if (best < score) best = score;
+        }
+    }
+    return (best == HINT_SCORE_NONE) ? evaluateBoard(work) : best;
+}
+
+static bool slideBoard(int8_t *pBoard, int8_t vx, int8_t vy)
+{
+    bool moved = false;
+    int8_t stride = (vx > 0) ? -1 : (vx < 0) ? 1 : (vy > 0) ? -BOARD_SIZE : BOARD_SIZE;
+    for (int8_t i = 0; i < BOARD_SIZE; i++) {
+        int8_t base = (vx != 0) ? i * BOARD_SIZE : i; // Leading edge of the line
+        if (stride < 0) base -= stride * (BOARD_SIZE - 1);
+        int8_t dest = base, lastTile = 0;
+        for (int8_t j = 0; j < BOARD_SIZE; j++) {
+            int8_t pos = base + stride * j, tile = pBoard[pos];
+            if (tile == 0) continue;
+            pBoard[pos] = 0;
+            if (tile == lastTile) {
+                pBoard[dest - stride]++;
+                lastTile = 0;
+                moved = true;
+            } else {
+                pBoard[dest] = tile;
+                if (dest != pos) moved = true;
+                dest += stride;
+                lastTile = tile;
+            }
+        }
+    }
+    return moved;
+}
+
+static int16_t evaluateBoard(const int8_t *pBoard)
+{
+    int16_t score = 0;
+    int8_t maxTile = 0, maxPos = 0;
+    for (int8_t y = 0; y < BOARD_SIZE; y++) {
+        for (int8_t x = 0; x < BOARD_SIZE; x++) {
+            int8_t pos = y * BOARD_SIZE + x, tile = pBoard[pos];
+            if (tile == 0) {
+                score += HINT_SCORE_EMPTY;
+                continue;
+            }
+            if (x < BOARD_SIZE - 1 && pBoard[pos + 1] == tile) score += HINT_SCORE_PAIR;
+            if (y < BOARD_SIZE - 1 && pBoard[pos + BOARD_SIZE] == tile) score += HINT_SCORE_PAIR;
+            if (maxTile < tile) {
+                maxTile = tile;
+                maxPos = pos;
+            }
+        }
+    }
+    int8_t x = maxPos % BOARD_SIZE, y = maxPos / BOARD_SIZE;
+    if ((x == 0 || x == BOARD_SIZE - 1) && (y == 0 || y == BOARD_SIZE - 1)) {
+        score += maxTile * HINT_SCORE_CORNER;
+    }
+    return score;
+}
+
+static bool isHintPixel(int8_t x, int8_t y)
+{
+    if (hintStep < HINT_DIRS || hintDir < 0 || !isHintEnabled()) return false;
+    int8_t vx = hintVx(hintDir), vy = hintVy(hintDir);
+    if (vx != 0) return (y > 0 && y < BOARD_SIZE - 1 && x == ((vx > 0) ? BOARD_SIZE - 1 : 0));
+    return (x > 0 && x < BOARD_SIZE - 1 && y == ((vy > 0) ? BOARD_SIZE - 1 : 0));
+}